@@ -1,9 +1,13 @@
 #include "dated_file.h"
 
+#include <algorithm>
+#include <cctype>
 #include <iostream>
 #include <sys/stat.h>
 
 #include "color.h"
+#include "diagnostics.h"
+#include "io_budget.h"
 #include "utility.h"
 
 DatedFile::DatedFile(const Settings& settings,
@@ -22,7 +26,9 @@ DatedFile::DatedFile(const Settings& settings,
         return;
     }
 
-    std::vector<std::string> tags = settings.get_tags(extension.substr(1)); // Remove dot when calling get_tags
+    // Identify the real container from its first bytes
+    MediaType media_type = this->get_media_type();
+    std::vector<std::string> tags = this->get_candidate_tags();
 
     // If tags are empty, return with blank name (skip)
     if (tags.empty()) {
@@ -30,18 +36,25 @@ DatedFile::DatedFile(const Settings& settings,
         return;
     }
 
+    // Content the sniffer does not know may still be read by Exiv2. If not, it is
+    // likely truncated or corrupt, so only the inode tags are worth trying.
+    if (media_type == MediaType::Unknown) {
+        bool has_metadata_tags = std::any_of(tags.begin(), tags.end(), [](const std::string& tag) {
+            return !tag.starts_with("inode.");
+        });
+        if (has_metadata_tags && !exiv2_recognises(this->path)) {
+            report(DiagCode::UnrecognisedContent, this->path);
+            std::erase_if(tags, [](const std::string& tag) { return !tag.starts_with("inode."); });
+        }
+    }
+
     // Try each tag in order of priority
     std::string new_name;
     for (const auto& tag : tags) {
-        try {
-            new_name = get_metadata_date(tag, this->settings.get_date_format());
-            if (!new_name.empty()) {
-                this->current_date_tag = this->default_date_tag = tag;
-                break;
-            }
-        }
-        catch (...) {
-            std::cerr << YELLOW << "[WARNING] " << RESET << "Failed to read metadata from " << this->path.filename().string() << " using tag: " << tag << std::endl;
+        new_name = get_metadata_date(tag, this->settings.get_date_format());
+        if (!new_name.empty()) {
+            this->current_date_tag = this->default_date_tag = tag;
+            break;
         }
     }
 
@@ -51,26 +64,52 @@ DatedFile::DatedFile(const Settings& settings,
         return;
     }
 
-    // Add extension and save proposed name
-    new_name += extension;
+    // Add extension (with a sidecar's inner one, e.g. .CR2.xmp) and save proposed name
+    new_name += get_group_suffix(this->path);
     this->add_proposed_name(new_name);
 }
 
+DatedFile::DatedFile(const DatedFile& leader, fs::path path)
+    :   settings{leader.settings},
+        path{path},
+        current_date_tag{leader.current_date_tag},
+        default_date_tag{leader.default_date_tag},
+        proposed_name_counts_ptr{leader.proposed_name_counts_ptr} {
+
+    // Take the name from the leader of the group without reading any metadata
+    this->add_proposed_name(leader.get_group_name(this->path));
+}
+
 fs::path DatedFile::get_path() const { return this->path; }
 
 std::string DatedFile::get_proposed_name() const { return this->proposed_name; }
 
+std::string DatedFile::get_group_name(const fs::path& member) const {
+    if (this->is_skipped()) return "";
+
+    // Swap this file's suffix for the member's own (e.g. .CR2 or .CR2.xmp)
+    std::string suffix = get_group_suffix(this->path);
+    std::string base = this->proposed_name.ends_with(suffix)
+        ? this->proposed_name.substr(0, this->proposed_name.size() - suffix.size())
+        : this->proposed_name;
+    return base + get_group_suffix(member);
+}
+
 bool DatedFile::is_skipped() const { return this->proposed_name.empty(); }
 
+bool DatedFile::is_dated_by_inode() const { return this->default_date_tag.starts_with("inode."); }
+
 bool DatedFile::is_clashing() const {
     if (this->is_skipped()) return (*this->proposed_name_counts_ptr)[this->path.filename().string()] > 1;
     else return (*this->proposed_name_counts_ptr)[this->proposed_name] > 1;
 }
 
-void DatedFile::edit_proposed_name() {
+// Ask the user for a new name without changing anything, returning the chosen tag and name
+// (nullopt keeps the current name). Only reads metadata, so it can run without holding any lock.
+std::optional<std::pair<std::string, std::string>> DatedFile::prompt_proposed_name() {
     std::cout << CYAN << "\n\nPossible names for " << this->path.filename().string() << RESET << std::endl;
 
-    std::string extension = this->path.extension();
+    std::string suffix = get_group_suffix(this->path);
     std::vector<std::pair<std::string, std::string>> possible_names;
 
     // Skip and Custom name options
@@ -79,18 +118,13 @@ void DatedFile::edit_proposed_name() {
 
     // Build list of possible names using all tags for the extension (in reverse order)
     std::vector<std::pair<std::string, std::string>> temp_names;
-    for (const auto& tag : this->settings.get_tags(extension.substr(1))) {
-        std::string date;
-        try {
-            date = get_metadata_date(tag, this->settings.get_date_format());
-        }
-        catch(Exiv2::Error const&) {
-            // Silently ignore any metadata errors
-            // The user is warned about any of these during initial file load
-            continue;
-        }
+    for (const auto& tag : this->get_candidate_tags()) {
+        // Silently ignore any metadata errors
+        // The user is warned about any of these during initial file load
+        SuppressDiagnostics suppress;
+        std::string date = get_metadata_date(tag, this->settings.get_date_format());
 
-        if (!date.empty()) temp_names.emplace_back(tag, date + extension);
+        if (!date.empty()) temp_names.emplace_back(tag, date + suffix);
     }
 
     // Insert in reverse order
@@ -114,7 +148,7 @@ void DatedFile::edit_proposed_name() {
         std::getline(std::cin, input); // Read the entire line as a string
 
         // No-op if the user just hits enter
-        if (input.empty()) break;
+        if (input.empty()) return std::nullopt;
 
         // Convert input to size_t
         size_t selection;
@@ -131,24 +165,38 @@ void DatedFile::edit_proposed_name() {
             continue; // Invalid range, continue the loop
         }
         
-        const auto& selected = possible_names[selection - 1];
-        this->current_date_tag = selected.first;
-
+        auto selected = possible_names[selection - 1];
         if (selected.first == "Custom") {
             std::cout << "Enter a custom name: ";
-            std::string new_name;
-            std::getline(std::cin, new_name);
-            this->set_proposed_name(new_name);
+            std::getline(std::cin, selected.second);
         }
-        else if (selected.first == "Skip") this->set_skipped();
-        else this->set_proposed_name(selected.second);
-        
-        break;
+
+        return selected;
     }
 }
 
+void DatedFile::apply_proposed_name(const std::pair<std::string, std::string>& choice) {
+    this->current_date_tag = choice.first;
+    this->set_proposed_name(choice.second); // Skip carries an empty name
+}
+
 void DatedFile::set_skipped() { this->set_proposed_name(""); }
 
+void DatedFile::follow(const DatedFile& leader) {
+    this->current_date_tag = leader.current_date_tag;
+    this->default_date_tag = leader.default_date_tag;
+    this->set_proposed_name(leader.get_group_name(this->path));
+}
+
+void DatedFile::set_proposed_name_counts(std::shared_ptr<std::map<std::string, int>> proposed_name_counts_ptr) {
+    if (!proposed_name_counts_ptr) throw std::runtime_error("Invalid shared pointer passed to DatedFile");
+
+    // Move this file's name from the old counts to the new ones
+    this->remove_proposed_name();
+    this->proposed_name_counts_ptr = proposed_name_counts_ptr;
+    this->add_proposed_name(this->proposed_name);
+}
+
 bool DatedFile::rename() {
     if (this->is_skipped()) return false;
     if (this->proposed_name == this->path.filename().string()) return false;
@@ -156,58 +204,80 @@ bool DatedFile::rename() {
     try {
         auto new_path = this->path;
         new_path.replace_filename(this->proposed_name);
+        IoOperation rename_op(IoKind::Rename);
         fs::rename(this->path, new_path);
     }
     catch (const fs::filesystem_error& e) {
-        std::cerr << RED << "[ERROR] " << RESET << e.what() << std::endl;
+        report(DiagCode::RenameFailed, this->path, e.code().message());
         return false;
     }
 
     return true;
 }
 
-std::string DatedFile::get_exif_date(const Exiv2::Image::UniquePtr& media, const std::string& exif_tag, const std::string& date_format) {
-    try {
-        // First try grab Exif.Photo.DateTimeOriginal if available
-        Exiv2::ExifData &exifData = media->exifData();
-        if (!exifData.empty()) {
-            Exiv2::ExifKey dateTimeOriginalKey(exif_tag);
-            Exiv2::ExifData::iterator exifEntry = exifData.findKey(dateTimeOriginalKey);
-            if (exifEntry != exifData.end()) {
-                // Format time
-                auto time = exif_date_to_time_point(exifEntry->toString());
-                return time_point_to_formatted_string(time, date_format);
-            }
-        }
-    }
-    catch(std::runtime_error& e) {
-        std::cerr << RED << "[ERROR] " << RESET << e.what() << std::endl;
+MediaType DatedFile::get_media_type() const {
+    if (!this->media_type) this->media_type = sniff_media_type(this->path);
+    return *this->media_type;
+}
+
+std::vector<std::string> DatedFile::get_candidate_tags() const {
+    std::string extension = this->path.extension();
+    if (!extension.empty()) extension = extension.substr(1); // Remove dot when calling get_tags
+
+    // Trust the extension unless the content says it is something else
+    MediaType media_type = this->get_media_type();
+    if (media_type != MediaType::Unknown && !media_type_matches_extension(media_type, extension)) {
+        std::vector<std::string> tags = this->settings.get_tags(media_type_extension(media_type));
+        if (!tags.empty()) return tags;
     }
-    catch(...) {
-        std::cerr << RED << "[ERROR] " << RESET "Failed to read EXIF data from " << this->path.filename().string() << std::endl;
+
+    return this->settings.get_tags(extension);
+}
+
+std::string DatedFile::get_exif_date(const Exiv2::Image::UniquePtr& media, const std::string& exif_tag, const std::string& date_format) {
+    // A missing tag is expected and not worth reporting
+    Exiv2::ExifData &exifData = media->exifData();
+    if (exifData.empty()) return "";
+    Exiv2::ExifData::iterator exifEntry = exifData.findKey(Exiv2::ExifKey(exif_tag));
+    if (exifEntry == exifData.end()) return "";
+
+    std::string value = exifEntry->toString();
+    auto time = exif_date_to_time_point(value);
+    if (!time) {
+        report(DiagCode::DateParseFailed, this->path, exif_tag + " = " + value);
+        return "";
     }
 
-    return "";
+    // Format time
+    return time_point_to_formatted_string(*time, date_format);
 }
 
 std::string DatedFile::get_xmp_date(const Exiv2::Image::UniquePtr& media, const std::string& xmp_tag, const std::string& date_format) {
-    try {
-        Exiv2::XmpData &xmpData = media->xmpData();
-        if (!xmpData.empty()) {
-            Exiv2::XmpKey modificationDateKey(xmp_tag);
-            Exiv2::XmpData::iterator xmpEntry = xmpData.findKey(modificationDateKey);
-            if (xmpEntry != xmpData.end()) {
-                // Format time
-                auto time = xmp_epoch_to_time_point(xmpEntry->toInt64());
-                return time_point_to_formatted_string(time, date_format);
-            }
-        }
+    // A missing tag is expected and not worth reporting
+    Exiv2::XmpData &xmpData = media->xmpData();
+    if (xmpData.empty()) return "";
+    Exiv2::XmpData::iterator xmpEntry = xmpData.findKey(Exiv2::XmpKey(xmp_tag));
+    if (xmpEntry == xmpData.end()) return "";
+
+    // Videos store seconds since 1904 (nine or more digits for any date after 1907), sidecars
+    // store dates as text which may be just a year (both are XMP text values)
+    std::string value = xmpEntry->toString();
+    bool epoch = value.size() > 8 && std::all_of(value.begin(), value.end(), [](unsigned char c) { return std::isdigit(c); });
+
+    std::optional<std::chrono::system_clock::time_point> time;
+    if (epoch) {
+        time = xmp_epoch_to_time_point(xmpEntry->toInt64());
     }
-    catch(...) {
-        std::cerr << RED << "[ERROR] " << RESET "Failed to read XMP data from " << this->path.filename().string() << std::endl;
+    else {
+        time = xmp_date_to_time_point(value);
+        if (!time) {
+            report(DiagCode::DateParseFailed, this->path, xmp_tag + " = " + value);
+            return "";
+        }
     }
 
-    return "";
+    // Format time
+    return time_point_to_formatted_string(*time, date_format);
 }
 
 std::string DatedFile::get_inode_date(const std::string& inode_tag, const std::string& date_format) {
@@ -215,7 +285,7 @@ std::string DatedFile::get_inode_date(const std::string& inode_tag, const std::s
 
     // Attempt to get file stat
     if (stat(this->path.c_str(), &file_stat) != 0) {
-        std::cerr << RED << "[ERROR] " << RESET "Failed to stat file " << this->path.filename().string() << std::endl;
+        report(DiagCode::StatFailed, this->path);
         return "";
     }
 
@@ -225,7 +295,7 @@ std::string DatedFile::get_inode_date(const std::string& inode_tag, const std::s
     else if (inode_tag == "inode.atime") inode_time = file_stat.st_atime;
     else if (inode_tag == "inode.ctime") inode_time = file_stat.st_ctime;
     else {
-        std::cerr << RED << "[ERROR] " << RESET "Invalid inode tag: " << inode_tag << std::endl;
+        report(DiagCode::InvalidTag, this->path, inode_tag);
         return "";
     }
 
@@ -235,30 +305,51 @@ std::string DatedFile::get_inode_date(const std::string& inode_tag, const std::s
 }
 
 std::string DatedFile::get_metadata_date(const std::string& tag, const std::string& date_format) {
-    // Handle potential inode tag first
-    if (tag.starts_with("inode.")) return get_inode_date(tag, date_format);
+    // Handle potential inode tag first (formatting in local time may throw if the zone is unavailable)
+    if (tag.starts_with("inode.")) {
+        try {
+            return get_inode_date(tag, date_format);
+        }
+        catch (const std::exception& e) {
+            report(DiagCode::StatFailed, this->path, tag + ": " + e.what());
+            return "";
+        }
+    }
 
-    // Load the image or video file
-    Exiv2::Image::UniquePtr media = Exiv2::ImageFactory::open(this->path.string());
-    if (!media.get()) {
-        std::cerr << RED << "[ERROR] " << RESET "Cannot open " << this->path.filename().string() << std::endl;
+    // Test whether this is Exif or Xmp before opening anything
+    bool exif = tag.starts_with("Exif.");
+    if (!exif && !tag.starts_with("Xmp.")) {
+        report(DiagCode::InvalidTag, this->path, tag);
         return "";
     }
 
-    // Read the metadata from the file
-    media->readMetadata();
+    MediaType media_type = this->get_media_type();
 
-    // Test whether this is Exif or Xmp
-    if (tag.starts_with("Exif.")) return get_exif_date(media, tag, date_format);
-    else if (tag.starts_with("Xmp.")) return get_xmp_date(media, tag, date_format);
-    else {
-        std::cerr << RED << "[ERROR] " << RESET "Invalid tag: " << tag << std::endl;
-        Exiv2::XmpParser::terminate();
+    // Exiv2 reports corrupt files and unknown keys by throwing, so stop that here
+    // (along with overflow, allocation and time zone errors, so one bad file cannot end the run)
+    try {
+        // Only opening the file and reading its metadata count against the I/O budget
+        Exiv2::Image::UniquePtr media;
+        {
+            IoOperation read_op(IoKind::Read);
+
+            // Load the image or video file with the parser for its detected type (or let Exiv2 detect it)
+            media = open_media(this->path, media_type);
+
+            // Read the metadata from the file
+            if (media.get()) media->readMetadata();
+        }
+        if (!media.get()) {
+            report(DiagCode::CannotOpen, this->path);
+            return "";
+        }
+
+        return exif ? get_exif_date(media, tag, date_format) : get_xmp_date(media, tag, date_format);
+    }
+    catch (const std::exception& e) {
+        report(exif ? DiagCode::ExifReadFailed : DiagCode::XmpReadFailed, this->path, tag + ": " + e.what());
         return "";
     }
-
-    Exiv2::XmpParser::terminate();
-    return "";
 }
 
 void DatedFile::add_proposed_name(const std::string& proposed_name) {
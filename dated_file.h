@@ -4,8 +4,10 @@
 #include <exiv2/exiv2.hpp>
 #include <filesystem>
 #include <map>
+#include <optional>
 #include <vector>
 
+#include "media_type.h"
 #include "settings.h"
 
 namespace fs = std::filesystem;
@@ -13,11 +15,14 @@ namespace fs = std::filesystem;
 class DatedFile {
     Settings settings;
     fs::path path;
+    mutable std::optional<MediaType> media_type;   // Sniffed on first use
     std::string proposed_name;
     std::string current_date_tag;
     std::string default_date_tag;
     std::shared_ptr<std::map<std::string, int>> proposed_name_counts_ptr;
 
+    MediaType get_media_type() const;
+    std::vector<std::string> get_candidate_tags() const;
     std::string get_exif_date(const Exiv2::Image::UniquePtr& media, const std::string& exif_tag, const std::string& date_format);
     std::string get_xmp_date(const Exiv2::Image::UniquePtr& media, const std::string& xmp_tag, const std::string& date_format);
     std::string get_inode_date(const std::string& inode_tag, const std::string& date_format);
@@ -32,12 +37,18 @@ public:
         fs::path path,
         std::shared_ptr<std::map<std::string, int>> proposed_name_counts_ptr
     );
+    DatedFile(const DatedFile& leader, fs::path path);
     fs::path get_path() const;
     std::string get_proposed_name() const;
+    std::string get_group_name(const fs::path& member) const;
     bool is_skipped() const;
+    bool is_dated_by_inode() const;
     bool is_clashing() const;
-    void edit_proposed_name();
+    std::optional<std::pair<std::string, std::string>> prompt_proposed_name();
+    void apply_proposed_name(const std::pair<std::string, std::string>& choice);
     void set_skipped();
+    void follow(const DatedFile& leader);
+    void set_proposed_name_counts(std::shared_ptr<std::map<std::string, int>> proposed_name_counts_ptr);
     bool rename();
 };
 
@@ -0,0 +1,156 @@
+#include "diagnostics.h"
+
+#include <array>
+#include <atomic>
+#include <fstream>
+#include <iomanip>
+#include <iostream>
+#include <memory>
+#include <mutex>
+#include <sstream>
+#include <vector>
+
+#include "color.h"
+
+namespace {
+
+constexpr size_t IMMEDIATE_LIMIT = 3;   // Reports of each code printed as they happen
+constexpr size_t CODE_COUNT = static_cast<size_t>(DiagCode::Count);
+
+struct CodeInfo {
+    const char* name;
+    bool error;
+    const char* message;
+};
+
+const std::array<CodeInfo, CODE_COUNT> CODES = {{
+    {"exif-read-failed",     true,  "Failed to read EXIF data from"},
+    {"xmp-read-failed",      true,  "Failed to read XMP data from"},
+    {"date-parse-failed",    false, "Failed to parse date in"},
+    {"stat-failed",          true,  "Failed to stat file"},
+    {"cannot-open",          true,  "Cannot open"},
+    {"unrecognised-content", false, "Unrecognised content, only inode tags used for"},
+    {"invalid-tag",          true,  "Invalid tag for"},
+    {"no-valid-date",        false, "Ignoring file without valid date:"},
+    {"rename-failed",        true,  "Failed to rename"},
+}};
+
+struct Record {
+    DiagCode code;
+    std::string path;
+    std::string detail;
+};
+
+// Each thread appends to its own buffer; buffers are only read once the work is done
+using Buffer = std::vector<Record>;
+
+std::array<std::atomic<size_t>, CODE_COUNT> counts{};
+std::array<std::string, CODE_COUNT> examples;   // Written only by the first reporter of each code
+std::atomic<bool> logging = false;
+std::mutex buffers_mutex;
+std::vector<std::shared_ptr<Buffer>> buffers;
+thread_local int suppressed = 0;
+
+Buffer& thread_buffer() {
+    thread_local std::shared_ptr<Buffer> buffer = [] {
+        auto created = std::make_shared<Buffer>();
+        std::lock_guard<std::mutex> lock(buffers_mutex);
+        buffers.push_back(created);
+        return created;
+    }();
+    return *buffer;
+}
+
+std::string format_report(DiagCode code, const std::filesystem::path& path, const std::string& detail) {
+    const CodeInfo& info = CODES[static_cast<size_t>(code)];
+    std::string text = std::string(info.message) + " " + path.filename().string();
+    if (!detail.empty()) text += " (" + detail + ")";
+    return text;
+}
+
+std::string json_escape(const std::string& text) {
+    std::ostringstream escaped;
+    for (unsigned char c : text) {
+        switch (c) {
+            case '"':  escaped << "\\\""; break;
+            case '\\': escaped << "\\\\"; break;
+            case '\n': escaped << "\\n"; break;
+            case '\r': escaped << "\\r"; break;
+            case '\t': escaped << "\\t"; break;
+            default:
+                if (c < 0x20) escaped << "\\u" << std::hex << std::setw(4) << std::setfill('0') << static_cast<int>(c) << std::dec;
+                else escaped << c;
+        }
+    }
+    return escaped.str();
+}
+
+} // namespace
+
+void report(DiagCode code, const std::filesystem::path& path, const std::string& detail) {
+    if (suppressed > 0) return;
+
+    size_t index = static_cast<size_t>(code);
+    size_t seen = counts[index].fetch_add(1, std::memory_order_relaxed);
+
+    if (logging.load(std::memory_order_relaxed)) thread_buffer().push_back({code, path.string(), detail});
+
+    // Only the first few reports of a code are formatted and written out
+    if (seen >= IMMEDIATE_LIMIT + 1) return;
+
+    const CodeInfo& info = CODES[index];
+    std::string line = info.error ? RED "[ERROR] " RESET : YELLOW "[WARNING] " RESET;
+    if (seen < IMMEDIATE_LIMIT) {
+        std::string text = format_report(code, path, detail);
+        if (seen == 0) examples[index] = text;
+        line += text;
+    }
+    else {
+        line += std::string("Further ") + info.name + " reports suppressed, see summary";
+    }
+    line += "\n";
+    std::cerr << line << std::flush;
+}
+
+void enable_diagnostics_log() { logging = true; }
+
+bool write_diagnostics_log(const std::string& filepath) {
+    std::ofstream log(filepath);
+    if (!log) {
+        std::cerr << RED << "[ERROR] " << RESET << "Failed to create error log: " << filepath << std::endl;
+        return false;
+    }
+
+    std::lock_guard<std::mutex> lock(buffers_mutex);
+    for (const auto& buffer : buffers) {
+        for (const auto& record : *buffer) {
+            const CodeInfo& info = CODES[static_cast<size_t>(record.code)];
+            log << "{\"code\":\"" << info.name << "\","
+                << "\"severity\":\"" << (info.error ? "error" : "warning") << "\","
+                << "\"path\":\"" << json_escape(record.path) << "\","
+                << "\"detail\":\"" << json_escape(record.detail) << "\"}\n";
+        }
+    }
+    return true;
+}
+
+void print_diagnostics_summary() {
+    // Everything was already shown unless some reports were suppressed
+    bool any_suppressed = false;
+    for (const auto& count : counts) {
+        if (count > IMMEDIATE_LIMIT) any_suppressed = true;
+    }
+    if (!any_suppressed) return;
+
+    std::cerr << YELLOW << "\nDiagnostics summary:" << RESET << std::endl;
+    for (size_t i = 0; i < CODE_COUNT; ++i) {
+        size_t count = counts[i];
+        if (count == 0) continue;
+        std::cerr << std::setw(8) << count << "  " << std::left << std::setw(22) << CODES[i].name << std::right
+                  << GRAY << "e.g. " << examples[i] << RESET << std::endl;
+    }
+}
+
+SuppressDiagnostics::SuppressDiagnostics() { suppressed++; }
+
+SuppressDiagnostics::~SuppressDiagnostics() { suppressed--; }
@@ -0,0 +1,38 @@
+#ifndef DIAGNOSTICS_H
+#define DIAGNOSTICS_H
+
+#include <filesystem>
+#include <string>
+
+enum class DiagCode {
+    ExifReadFailed,
+    XmpReadFailed,
+    DateParseFailed,
+    StatFailed,
+    CannotOpen,
+    UnrecognisedContent,
+    InvalidTag,
+    NoValidDate,
+    RenameFailed,
+    Count   // Number of codes, not a code itself
+};
+
+// Record a per-file problem. The first few of each code are printed straight away,
+// the rest are only counted and shown in the summary.
+void report(DiagCode code, const std::filesystem::path& path, const std::string& detail = "");
+
+// Keep every record so it can be written as JSON lines at the end
+void enable_diagnostics_log();
+bool write_diagnostics_log(const std::string& filepath);
+void print_diagnostics_summary();
+
+// Silences reports on this thread while alive (e.g. when re-reading tags interactively)
+class SuppressDiagnostics {
+public:
+    SuppressDiagnostics();
+    ~SuppressDiagnostics();
+    SuppressDiagnostics(const SuppressDiagnostics&) = delete;
+    SuppressDiagnostics& operator=(const SuppressDiagnostics&) = delete;
+};
+
+#endif // DIAGNOSTICS_H
@@ -0,0 +1,161 @@
+#include "io_budget.h"
+
+#include <algorithm>
+#include <fcntl.h>
+#include <iostream>
+#include <optional>
+#include <sstream>
+#include <string>
+#include <thread>
+#include <unistd.h>
+
+#include "color.h"
+
+namespace {
+
+constexpr double MIN_FACTOR = 1.0 / 16;    // Never back off below this share of a limit
+constexpr double RECOVERY_STEP = 0.02;     // Share regained after each normal operation
+constexpr double SPIKE_RATIO = 4.0;        // Latency above this multiple of the average is a spike
+constexpr double SPIKE_FLOOR = 0.01;       // ...provided it is also above this many seconds
+constexpr size_t WARMUP_SAMPLES = 16;      // Operations measured before backing off
+
+// Bytes read by this process so far (-1 for counters the kernel does not report)
+ProcessReads read_process_io() {
+    ProcessReads reads;
+    char buffer[512];
+    int fd = open("/proc/self/io", O_RDONLY | O_CLOEXEC);
+    if (fd < 0) return reads;
+    ssize_t length = read(fd, buffer, sizeof(buffer) - 1);
+    close(fd);
+    if (length <= 0) return reads;
+    buffer[length] = '\0';
+    reads.own_bytes = length;
+
+    std::istringstream io(buffer);
+    std::string key;
+    int64_t value;
+    while (io >> key >> value) {
+        if (key == "rchar:") reads.syscall_bytes = value;
+        else if (key == "read_bytes:") reads.storage_bytes = value;
+    }
+    return reads;
+}
+
+} // namespace
+
+IoBudget& io_budget() {
+    static IoBudget budget;
+    return budget;
+}
+
+void IoBudget::configure(double max_iops, double max_read_mbps, double max_renames_per_sec) {
+    std::lock_guard<std::mutex> lock(this->mutex);
+    auto now = std::chrono::steady_clock::now();
+
+    this->ops = {max_iops, max_iops, now};
+    this->bytes = {max_read_mbps * 1024 * 1024, max_read_mbps * 1024 * 1024, now};
+    this->renames = {max_renames_per_sec, max_renames_per_sec, now};
+
+    if (this->bytes.rate > 0) {
+        this->last_reads = read_process_io();
+        if (this->last_reads.syscall_bytes < 0 && this->last_reads.storage_bytes < 0) {
+            std::cerr << YELLOW << "[WARNING] " << RESET << "Cannot measure bytes read on this system, ignoring read limit" << std::endl;
+            this->bytes.rate = 0;
+        }
+    }
+
+    this->enabled = this->ops.rate > 0 || this->bytes.rate > 0 || this->renames.rate > 0;
+}
+
+void IoBudget::refill(Bucket& bucket, std::chrono::steady_clock::time_point now) {
+    // Allow bursts of up to one second at the current rate
+    double rate = bucket.rate * this->factor;
+    double elapsed = std::chrono::duration<double>(now - bucket.refilled).count();
+    bucket.tokens = std::min(bucket.tokens + elapsed * rate, std::max(rate, 1.0));
+    bucket.refilled = now;
+}
+
+void IoBudget::wait_for(Bucket& bucket, double needed, std::unique_lock<std::mutex>& lock) {
+    if (bucket.rate <= 0) return;
+
+    while (true) {
+        this->refill(bucket, std::chrono::steady_clock::now());
+        if (bucket.tokens >= needed) return;
+
+        // Sleep until enough tokens should have accumulated
+        std::chrono::duration<double> delay((needed - bucket.tokens) / (bucket.rate * this->factor));
+        lock.unlock();
+        std::this_thread::sleep_for(delay);
+        lock.lock();
+    }
+}
+
+void IoBudget::acquire(IoKind kind) {
+    if (!this->enabled) return;
+    std::unique_lock<std::mutex> lock(this->mutex);
+
+    // Bytes are charged after each read, so only wait for the bucket to be out of debt
+    this->wait_for(this->bytes, 0, lock);
+    this->wait_for(this->ops, 1, lock);
+    if (this->ops.rate > 0) this->ops.tokens -= 1;
+
+    if (kind == IoKind::Rename) {
+        this->wait_for(this->renames, 1, lock);
+        if (this->renames.rate > 0) this->renames.tokens -= 1;
+    }
+}
+
+void IoBudget::release(IoKind kind, std::chrono::steady_clock::duration latency) {
+    if (!this->enabled) return;
+
+    // Sample the counters before taking the lock so other threads are not held up
+    std::optional<ProcessReads> reads;
+    if (kind == IoKind::Read && this->bytes.rate > 0) reads = read_process_io();
+
+    std::lock_guard<std::mutex> lock(this->mutex);
+    if (reads) this->charge_reads(*reads);
+    this->adapt(std::chrono::duration<double>(latency).count());
+}
+
+void IoBudget::charge_reads(const ProcessReads& reads) {
+    // Samples from other threads may arrive out of order, only move forwards
+    auto advance = [](int64_t now, int64_t& last) {
+        if (now < 0 || now <= last) return int64_t{0};
+        int64_t delta = now - last;
+        last = now;
+        return delta;
+    };
+
+    // read() calls and page faults on mapped files (used by the TIFF based parsers) are counted
+    // separately, and a read() from storage shows up in both, so charge the larger of the two
+    int64_t syscall_delta = advance(reads.syscall_bytes, this->last_reads.syscall_bytes);
+    int64_t storage_delta = advance(reads.storage_bytes, this->last_reads.storage_bytes);
+    syscall_delta = std::max<int64_t>(0, syscall_delta - this->last_reads.own_bytes);
+    this->last_reads.own_bytes = reads.own_bytes; // Shows up in rchar by the next sample
+
+    this->bytes.tokens -= std::max(syscall_delta, storage_delta);
+}
+
+void IoBudget::adapt(double latency) {
+    // Back off sharply when latency spikes and recover a little after each normal operation
+    if (this->samples >= WARMUP_SAMPLES && latency > SPIKE_FLOOR && latency > SPIKE_RATIO * this->baseline_latency) {
+        this->factor = std::max(MIN_FACTOR, this->factor / 2);
+    }
+    else {
+        this->factor = std::min(1.0, this->factor + RECOVERY_STEP);
+    }
+
+    // Track a slow moving average so a spike does not immediately become the new normal
+    double weight = this->samples < WARMUP_SAMPLES ? 1.0 / (this->samples + 1) : 0.05;
+    this->baseline_latency += weight * (latency - this->baseline_latency);
+    this->samples++;
+}
+
+IoOperation::IoOperation(IoKind kind) : kind{kind} {
+    io_budget().acquire(kind);
+    this->start = std::chrono::steady_clock::now();
+}
+
+IoOperation::~IoOperation() {
+    io_budget().release(this->kind, std::chrono::steady_clock::now() - this->start);
+}
@@ -0,0 +1,61 @@
+#ifndef IO_BUDGET_H
+#define IO_BUDGET_H
+
+#include <chrono>
+#include <cstdint>
+#include <mutex>
+
+enum class IoKind { Read, Rename };
+
+// Read counters from /proc/self/io
+struct ProcessReads {
+    int64_t syscall_bytes = -1;   // rchar: bytes returned by read() and friends
+    int64_t storage_bytes = -1;   // read_bytes: bytes fetched from storage, including page faults on mmap
+    int64_t own_bytes = 0;        // Bytes of /proc/self/io itself, not to be charged
+};
+
+// Token buckets limiting I/O operations, bytes read and renames per second.
+// Limits back off when operations get slower than usual and recover gradually.
+class IoBudget {
+    struct Bucket {
+        double rate = 0;     // Configured tokens per second (0 for no limit)
+        double tokens = 0;
+        std::chrono::steady_clock::time_point refilled;
+    };
+
+    std::mutex mutex;
+    Bucket ops;
+    Bucket bytes;
+    Bucket renames;
+    bool enabled = false;
+    double factor = 1.0;           // Share of the configured rates currently allowed
+    double baseline_latency = 0;   // Moving average of operation latency in seconds
+    size_t samples = 0;
+    ProcessReads last_reads;
+
+    void refill(Bucket& bucket, std::chrono::steady_clock::time_point now);
+    void wait_for(Bucket& bucket, double needed, std::unique_lock<std::mutex>& lock);
+    void adapt(double latency);
+    void charge_reads(const ProcessReads& reads);
+
+public:
+    void configure(double max_iops, double max_read_mbps, double max_renames_per_sec);
+    void acquire(IoKind kind);
+    void release(IoKind kind, std::chrono::steady_clock::duration latency);
+};
+
+IoBudget& io_budget();
+
+// Waits for budget on construction and charges the operation on destruction
+class IoOperation {
+    IoKind kind;
+    std::chrono::steady_clock::time_point start;
+
+public:
+    explicit IoOperation(IoKind kind);
+    ~IoOperation();
+    IoOperation(const IoOperation&) = delete;
+    IoOperation& operator=(const IoOperation&) = delete;
+};
+
+#endif // IO_BUDGET_H
@@ -0,0 +1,171 @@
+#include "media_type.h"
+
+#include <algorithm>
+#include <cctype>
+#include <fcntl.h>
+#include <string_view>
+#include <unistd.h>
+#include <vector>
+
+#include "io_budget.h"
+
+namespace {
+
+struct MediaTypeInfo {
+    MediaType type;
+    std::string extension;              // Canonical extension, used to look up tags
+    std::vector<std::string> aliases;   // Other extensions this content is expected under
+};
+
+const std::vector<MediaTypeInfo> MEDIA_TYPES = {
+    {MediaType::Jpeg, "jpg",  {"jpeg", "jpe", "jfif"}},
+    {MediaType::Png,  "png",  {}},
+    {MediaType::Gif,  "gif",  {}},
+    {MediaType::Webp, "webp", {}},
+    {MediaType::Bmp,  "bmp",  {"dib"}},
+    {MediaType::Psd,  "psd",  {}},
+    {MediaType::Svg,  "svg",  {}},
+    {MediaType::Avif, "avif", {}},
+    {MediaType::Heic, "heic", {"heif", "hif"}},
+    {MediaType::Jp2,  "jp2",  {"jpx", "jpf"}},
+    {MediaType::Tiff, "tiff", {"tif", "nef", "nrw", "dng", "arw", "sr2", "srf", "srw", "pef", "erf", "3fr", "mos", "kdc", "dcr"}},
+    {MediaType::Cr2,  "cr2",  {}},
+    {MediaType::Cr3,  "cr3",  {}},
+    {MediaType::Crw,  "crw",  {}},
+    {MediaType::Mrw,  "mrw",  {}},
+    {MediaType::Orf,  "orf",  {}},
+    {MediaType::Rw2,  "rw2",  {"rwl"}},
+    {MediaType::Raf,  "raf",  {}},
+    {MediaType::Mp4,  "mp4",  {"m4v", "m4a", "3gp", "3g2"}},
+    {MediaType::Mov,  "mov",  {"qt"}},
+    {MediaType::Mkv,  "mkv",  {"mka"}},
+    {MediaType::Webm, "webm", {}},
+    {MediaType::Avi,  "avi",  {}},
+    {MediaType::Mpeg, "mpeg", {"mpg", "mpe", "m2v", "vob"}},
+    {MediaType::Xmp,  "xmp",  {}},
+};
+
+const MediaTypeInfo* find_info(MediaType type) {
+    auto it = std::find_if(MEDIA_TYPES.begin(), MEDIA_TYPES.end(), [type](const MediaTypeInfo& info) {
+        return info.type == type;
+    });
+    return it != MEDIA_TYPES.end() ? &*it : nullptr;
+}
+
+MediaType sniff_iso_brand(std::string_view brand) {
+    if (brand == "avif" || brand == "avis") return MediaType::Avif;
+    if (brand == "heic" || brand == "heix" || brand == "heim" || brand == "heis" ||
+        brand == "hevc" || brand == "mif1" || brand == "msf1") return MediaType::Heic;
+    if (brand == "crx ") return MediaType::Cr3;
+    if (brand == "qt  ") return MediaType::Mov;
+    return MediaType::Mp4;
+}
+
+MediaType sniff_text(std::string_view header) {
+    // Skip a UTF-8 byte order mark and leading whitespace
+    if (header.starts_with("\xEF\xBB\xBF")) header.remove_prefix(3);
+    while (!header.empty() && std::isspace(static_cast<unsigned char>(header.front()))) header.remove_prefix(1);
+
+    if (header.starts_with("<?xpacket") || header.starts_with("<x:xmpmeta")) return MediaType::Xmp;
+    if (header.starts_with("<svg")) return MediaType::Svg;
+    if (header.starts_with("<?xml") || header.starts_with("<!DOCTYPE")) {
+        if (header.find("xmpmeta") != std::string_view::npos) return MediaType::Xmp;
+        if (header.find("<svg") != std::string_view::npos) return MediaType::Svg;
+    }
+    return MediaType::Unknown;
+}
+
+} // namespace
+
+MediaType sniff_media_type(const fs::path& path) {
+    using namespace std::string_view_literals;
+
+    // A single small read is enough to recognise every supported container
+    char buffer[512];
+    ssize_t length;
+    {
+        IoOperation read_op(IoKind::Read);
+        int fd = open(path.c_str(), O_RDONLY | O_CLOEXEC);
+        if (fd < 0) return MediaType::Unknown;
+        length = pread(fd, buffer, sizeof(buffer), 0);
+        close(fd);
+    }
+    if (length <= 0) return MediaType::Unknown;
+
+    std::string_view header(buffer, length);
+    auto at = [&header](size_t offset, std::string_view magic) {
+        return header.size() >= offset + magic.size() && header.substr(offset, magic.size()) == magic;
+    };
+
+    if (at(0, "\xFF\xD8\xFF"sv)) return MediaType::Jpeg;
+    if (at(0, "\x89PNG\r\n\x1A\n"sv)) return MediaType::Png;
+    if (at(0, "GIF87a"sv) || at(0, "GIF89a"sv)) return MediaType::Gif;
+    if (at(0, "RIFF"sv) && at(8, "WEBP"sv)) return MediaType::Webp;
+    if (at(0, "RIFF"sv) && at(8, "AVI "sv)) return MediaType::Avi;
+    if (at(0, "BM"sv)) return MediaType::Bmp;
+    if (at(0, "8BPS"sv)) return MediaType::Psd;
+    if (at(0, "\0\0\0\x0CjP  "sv)) return MediaType::Jp2;
+
+    // TIFF based raw formats
+    if (at(0, "II*\0"sv) && at(8, "CR"sv)) return MediaType::Cr2;
+    if (at(0, "II*\0"sv) || at(0, "MM\0*"sv)) return MediaType::Tiff;
+    if (at(0, "IIRO"sv) || at(0, "IIRS"sv) || at(0, "MMOR"sv)) return MediaType::Orf;
+    if (at(0, "IIU\0"sv)) return MediaType::Rw2;
+    if (at(0, "FUJIFILMCCD-RAW"sv)) return MediaType::Raf;
+    if (at(6, "HEAPCCDR"sv)) return MediaType::Crw;
+    if (at(0, "\0MRM"sv)) return MediaType::Mrw;
+
+    // ISO base media (MP4, MOV, HEIF, AVIF, CR3) and older QuickTime files
+    if (at(4, "ftyp"sv) && header.size() >= 12) return sniff_iso_brand(header.substr(8, 4));
+    if (at(4, "moov"sv) || at(4, "mdat"sv) || at(4, "wide"sv) || at(4, "free"sv) || at(4, "skip"sv) || at(4, "pnot"sv)) return MediaType::Mov;
+
+    // Matroska and WebM share the EBML header and differ in doctype
+    if (at(0, "\x1A\x45\xDF\xA3"sv)) {
+        return header.find("webm") != std::string_view::npos ? MediaType::Webm : MediaType::Mkv;
+    }
+    if (at(0, "\0\0\x01\xBA"sv) || at(0, "\0\0\x01\xB3"sv)) return MediaType::Mpeg;
+
+    return sniff_text(header);
+}
+
+std::string media_type_extension(MediaType type) {
+    const MediaTypeInfo* info = find_info(type);
+    return info ? info->extension : "";
+}
+
+bool media_type_matches_extension(MediaType type, const std::string& extension) {
+    const MediaTypeInfo* info = find_info(type);
+    if (!info) return false;
+
+    std::string lower = extension;
+    std::transform(lower.begin(), lower.end(), lower.begin(), [](unsigned char c) { return std::tolower(c); });
+    return lower == info->extension || std::find(info->aliases.begin(), info->aliases.end(), lower) != info->aliases.end();
+}
+
+Exiv2::Image::UniquePtr open_media(const fs::path& path, MediaType type) {
+    // Go straight to the parser for the detected format rather than probing every handler
+    auto io = std::make_unique<Exiv2::FileIo>(path.string());
+    switch (type) {
+        case MediaType::Jpeg: return Exiv2::newJpegInstance(std::move(io), false);
+        case MediaType::Gif:  return Exiv2::newGifInstance(std::move(io), false);
+        case MediaType::Webp: return Exiv2::newWebPInstance(std::move(io), false);
+        case MediaType::Tiff: return Exiv2::newTiffInstance(std::move(io), false);
+        case MediaType::Cr2:  return Exiv2::newCr2Instance(std::move(io), false);
+        case MediaType::Orf:  return Exiv2::newOrfInstance(std::move(io), false);
+        case MediaType::Rw2:  return Exiv2::newRw2Instance(std::move(io), false);
+        case MediaType::Raf:  return Exiv2::newRafInstance(std::move(io), false);
+        case MediaType::Xmp:  return Exiv2::newXmpInstance(std::move(io), false);
+        default:              return Exiv2::ImageFactory::open(std::move(io));
+    }
+}
+
+bool exiv2_recognises(const fs::path& path) {
+    // Let every Exiv2 handler check the header, for formats the sniffer has no entry for (e.g. EPS or TGA)
+    try {
+        IoOperation read_op(IoKind::Read);
+        return Exiv2::ImageFactory::getType(path.string()) != Exiv2::ImageType::none;
+    }
+    catch (const std::exception&) {
+        return false;
+    }
+}
@@ -0,0 +1,24 @@
+#ifndef MEDIA_TYPE_H
+#define MEDIA_TYPE_H
+
+#include <exiv2/exiv2.hpp>
+#include <filesystem>
+#include <string>
+
+namespace fs = std::filesystem;
+
+enum class MediaType {
+    Unknown,
+    Jpeg, Png, Gif, Webp, Bmp, Psd, Svg, Avif, Heic,
+    Jp2, Tiff, Cr2, Cr3, Crw, Mrw, Orf, Rw2, Raf,
+    Mp4, Mov, Mkv, Webm, Avi, Mpeg,
+    Xmp
+};
+
+MediaType sniff_media_type(const fs::path& path);
+std::string media_type_extension(MediaType type);
+bool media_type_matches_extension(MediaType type, const std::string& extension);
+Exiv2::Image::UniquePtr open_media(const fs::path& path, MediaType type);
+bool exiv2_recognises(const fs::path& path);
+
+#endif // MEDIA_TYPE_H
@@ -1,26 +1,40 @@
 
 #include <algorithm>
+#include <atomic>
 #include <cstdlib>
 #include <filesystem>
 #include <fstream>
+#include <functional>
 #include <getopt.h>
 #include <iostream>
 #include <map>
+#include <mutex>
+#include <optional>
 #include <set>
+#include <sys/ioctl.h>
+#include <thread>
+#include <tuple>
+#include <unistd.h>
 #include <vector>
 
 #include "color.h"
 #include "dated_file.h"
+#include "diagnostics.h"
+#include "io_budget.h"
 #include "settings.h"
+#include "utility.h"
 
 namespace fs = std::filesystem;
 
-// Display proposed file name changes
-void display_proposed_changes(const std::vector<DatedFile>& files, bool first_display) {
+// Display proposed file name changes (a page_size of 0 shows every file)
+void display_proposed_changes(const std::vector<DatedFile>& files, bool first_display, size_t page = 0, size_t page_size = 0) {
     if (!first_display) std::cout << std::endl;
 
+    size_t first = page * page_size;
+    size_t last = page_size ? std::min(files.size(), first + page_size) : files.size();
+
     std::cout << CYAN << "Files to rename:" << RESET << std::endl;
-    for (size_t i = files.size(); i > 0; --i) {
+    for (size_t i = last; i > first; --i) {
         std::string current_name = files[i-1].get_path().filename().string();
         std::string proposed_name = files[i-1].get_proposed_name();
 
@@ -51,22 +65,334 @@ bool has_clashes(const std::shared_ptr<std::map<std::string, int>>& name_count)
     return false; // No clashes found
 }
 
-// Rename files
-void rename_files(std::vector<DatedFile>& files) {
-    int skip_count = 0;
+// Rename files, returning how many were renamed
+size_t rename_files(std::vector<DatedFile>& files) {
+    size_t rename_count = 0;
     for (auto file : files) {
-        if (!file.rename()) skip_count++;
+        if (file.rename()) rename_count++;
     }
-    int rename_count = files.size() - skip_count;
+    return rename_count;
+}
+
+// Print how many files were renamed and skipped
+void print_rename_summary(size_t rename_count, size_t skip_count, size_t directory_count = 0) {
     std::cout << CYAN
               << "Renamed " << rename_count << " "
-              << (rename_count == 1 ? "file" : "files") << ". "
+              << (rename_count == 1 ? "file" : "files");
+    if (directory_count > 0) {
+        std::cout << " in " << directory_count << " "
+                  << (directory_count == 1 ? "directory" : "directories");
+    }
+    std::cout << ". "
               << "Skipped " << skip_count << " "
               << (skip_count == 1 ? "file" : "files") << "."
               << RESET
               << std::endl;
 }
 
+// Collect the files to rename from a directory (only those in selected, if given).
+// Names of files left out are still reserved so nothing is renamed over them.
+std::vector<fs::path> collect_paths(const fs::path& directory, const std::optional<DateFormatMatcher>& conforming_matcher,
+                                    const std::set<fs::path>& selected,
+                                    const std::shared_ptr<std::map<std::string, int>>& proposed_name_counts_ptr,
+                                    size_t& conforming_count) {
+    std::vector<fs::path> paths;
+    for (const auto& entry : fs::directory_iterator(directory)) {
+        if (fs::is_regular_file(entry)) {
+            // Files already named in the date format are done (a sidecar's inner extension is not part of the name)
+            bool conforming = conforming_matcher && conforming_matcher->matches(get_group_stem(entry.path()));
+            bool unselected = !selected.empty() && !selected.contains(entry.path());
+            if (conforming || unselected) {
+                (*proposed_name_counts_ptr)[entry.path().filename().string()]++;
+                if (conforming && !unselected) conforming_count++;
+                continue;
+            }
+
+            paths.push_back(entry.path());
+        }
+    }
+    return paths;
+}
+
+// Group files by stem so RAW, JPEG and sidecar are named together (or one group per file)
+std::vector<std::vector<fs::path>> group_paths(const std::vector<fs::path>& paths, bool pair) {
+    std::vector<std::vector<fs::path>> groups;
+    if (pair) {
+        std::map<std::string, std::vector<fs::path>> by_stem;
+        for (const auto& path : paths) by_stem[get_group_stem(path)].push_back(path);
+        for (auto& [stem, group] : by_stem) groups.push_back(std::move(group));
+    }
+    else {
+        for (const auto& path : paths) groups.push_back({path});
+    }
+    return groups;
+}
+
+// Read the dates for a group of files sharing a stem, naming them all after the cheapest member with a metadata date
+std::vector<DatedFile> load_group(const Settings& settings, std::vector<fs::path> group,
+                                  const std::shared_ptr<std::map<std::string, int>>& proposed_name_counts_ptr) {
+    if (group.size() == 1) return {DatedFile(settings, group.front(), proposed_name_counts_ptr)};
+
+    // Try sidecars first, then the smallest files (e.g. the JPEG rather than the RAW)
+    std::vector<std::tuple<bool, uintmax_t, fs::path>> costed;
+    for (auto& path : group) {
+        std::error_code ec;
+        uintmax_t size = fs::file_size(path, ec);
+        costed.emplace_back(!is_sidecar(path), ec ? UINTMAX_MAX : size, std::move(path));
+    }
+    std::sort(costed.begin(), costed.end());
+
+    // A date from the file system is only used if no member has one in its metadata
+    std::vector<DatedFile> members;
+    std::optional<DatedFile> leader;
+    std::optional<DatedFile> inode_leader;
+    for (const auto& [not_sidecar, size, path] : costed) {
+        if (leader) {
+            members.emplace_back(*leader, path);
+            continue;
+        }
+
+        members.emplace_back(settings, path, proposed_name_counts_ptr);
+        if (members.back().is_skipped()) continue;
+        if (!members.back().is_dated_by_inode()) leader = members.back();
+        else if (!inode_leader) inode_leader = members.back();
+    }
+    if (!leader) leader = inode_leader;
+
+    // Members read before the leader was found (and the leader itself) take the group name too
+    if (leader) {
+        for (auto& member : members) member.follow(*leader);
+    }
+
+    std::sort(members.begin(), members.end(), [](const DatedFile& a, const DatedFile& b) {
+        return a.get_path() > b.get_path();
+    });
+    return members;
+}
+
+// Read the dates for every group, returning the files that have one in reverse alphabetical order
+std::vector<DatedFile> load_files(const Settings& settings, std::vector<std::vector<fs::path>> groups,
+                                  const std::shared_ptr<std::map<std::string, int>>& proposed_name_counts_ptr,
+                                  bool locality_order) {
+    // Visit files in physical order to minimise seeking (the result is still sorted by path below)
+    if (locality_order) {
+        std::vector<std::pair<PhysicalLocation, std::vector<fs::path>>> located;
+        located.reserve(groups.size());
+        for (auto& group : groups) {
+            PhysicalLocation location{true, UINT64_MAX};
+            for (const auto& path : group) location = std::min(location, get_physical_location(path));
+            located.emplace_back(location, std::move(group));
+        }
+        std::sort(located.begin(), located.end());
+        for (size_t i = 0; i < located.size(); ++i) groups[i] = std::move(located[i].second);
+    }
+
+    // Read metadata for each file
+    std::vector<DatedFile> files;
+    for (const auto& group : groups) {
+        for (const auto& file : load_group(settings, group, proposed_name_counts_ptr)) {
+            // Ignore files without valid EXIF dates
+            if (!file.is_skipped()) files.push_back(file);
+            else report(DiagCode::NoValidDate, file.get_path());
+        }
+    }
+
+    // Sort by filename in reverse alphabetical order (will be shown in alphabetical order)
+    std::sort(files.begin(), files.end(), [](const DatedFile& a, const DatedFile& b) {
+        return a.get_path() > b.get_path(); // Reverse order based on paths
+    });
+    return files;
+}
+
+// Indices of the files named together with files[index] (only itself unless pairing)
+std::vector<size_t> get_group_indices(const std::vector<DatedFile>& files, size_t index, bool pair) {
+    if (!pair) return {index};
+
+    std::vector<size_t> indices;
+    std::string stem = get_group_stem(files[index].get_path());
+    for (size_t i = 0; i < files.size(); ++i) {
+        if (get_group_stem(files[i].get_path()) == stem) indices.push_back(i);
+    }
+    return indices;
+}
+
+// Run work(i) for every i below count on a pool of worker threads
+void run_in_pool(size_t count, const std::function<void(size_t)>& work) {
+    size_t thread_count = std::min<size_t>(count, std::max(1u, std::thread::hardware_concurrency()));
+    std::atomic<size_t> next = 0;
+
+    std::vector<std::jthread> workers;
+    for (size_t t = 0; t < thread_count; ++t) {
+        workers.emplace_back([&] {
+            for (size_t i = next++; i < count; i = next++) work(i);
+        });
+    }
+}
+
+// Read a NUL-delimited list of directories and files
+std::vector<fs::path> read_manifest(std::istream& in) {
+    std::vector<fs::path> entries;
+    std::string entry;
+    while (std::getline(in, entry, '\0')) {
+        if (!entry.empty()) entries.emplace_back(entry);
+    }
+    return entries;
+}
+
+// Files to rename in one directory, with their own clash scope
+struct BatchScope {
+    fs::path directory;
+    std::set<fs::path> selected;
+    bool whole_directory = false;
+    std::shared_ptr<std::map<std::string, int>> proposed_name_counts_ptr = std::make_shared<std::map<std::string, int>>();
+    std::vector<DatedFile> files;
+    std::string error;
+    size_t conforming_count = 0;
+    size_t rename_count = 0;
+    bool clashing = false;
+};
+
+// Rename files in many directories in one process
+int run_batch(const Settings& settings, const std::vector<fs::path>& entries, std::istream& confirm_in,
+              const std::optional<DateFormatMatcher>& conforming_matcher, bool force, bool locality_order, bool pair) {
+    // Build one scope per directory, merging files listed from the same directory
+    std::map<fs::path, BatchScope> scopes_by_directory;
+    for (const auto& entry : entries) {
+        std::error_code ec;
+        fs::path path = fs::weakly_canonical(entry, ec);
+        if (ec) path = entry;
+
+        if (fs::is_directory(path, ec)) {
+            BatchScope& scope = scopes_by_directory[path];
+            scope.directory = path;
+            scope.whole_directory = true;
+        }
+        else if (fs::is_regular_file(path, ec)) {
+            BatchScope& scope = scopes_by_directory[path.parent_path()];
+            scope.directory = path.parent_path();
+            scope.selected.insert(path);
+        }
+        else {
+            std::cerr << YELLOW << "[WARNING] " << RESET << "Ignoring entry that is not a file or directory: " << entry.string() << std::endl;
+        }
+    }
+
+    std::vector<BatchScope> scopes;
+    for (auto& [directory, scope] : scopes_by_directory) {
+        if (scope.whole_directory) scope.selected.clear();
+        scopes.push_back(std::move(scope));
+    }
+
+    // Read every directory on the worker pool
+    run_in_pool(scopes.size(), [&](size_t i) {
+        BatchScope& scope = scopes[i];
+        try {
+            std::vector<fs::path> paths = collect_paths(scope.directory, conforming_matcher, scope.selected,
+                                                        scope.proposed_name_counts_ptr, scope.conforming_count);
+            scope.files = load_files(settings, group_paths(paths, pair), scope.proposed_name_counts_ptr, locality_order);
+        }
+        catch (const fs::filesystem_error& e) {
+            scope.error = e.what();
+        }
+    });
+
+    // Show the plan for each directory and leave out any with clashes
+    size_t conforming_count = 0;
+    size_t file_count = 0;
+    size_t clashing_count = 0;
+    bool first_display = true;
+    for (auto& scope : scopes) {
+        conforming_count += scope.conforming_count;
+        if (!scope.error.empty()) {
+            std::cerr << RED << "[ERROR] " << RESET << scope.error << std::endl;
+            continue;
+        }
+        if (scope.files.empty()) continue;
+
+        if (!first_display) std::cout << std::endl;
+        std::cout << CYAN << scope.directory.string() << RESET << std::endl;
+        display_proposed_changes(scope.files, true);
+        first_display = false;
+
+        if (has_clashes(scope.proposed_name_counts_ptr)) {
+            if (!force) {
+                std::cout << CYAN << "Clashes detected, skipping this directory." << RESET << std::endl;
+                scope.clashing = true;
+                clashing_count++;
+                continue;
+            }
+            std::cerr << YELLOW << "[WARNING] " << RESET << "At least one clashing file will be deleted in " << scope.directory.string() << std::endl;
+        }
+        file_count += scope.files.size();
+    }
+
+    if (conforming_count > 0) {
+        std::cout << CYAN << "Skipped " << conforming_count << " already conforming "
+                  << (conforming_count == 1 ? "file" : "files") << "." << RESET << std::endl;
+    }
+
+    if (file_count == 0) {
+        if (clashing_count > 0) std::cout << CYAN << "Clashes detected, aborting. Use -f or --force to ignore clashes." << RESET << std::endl;
+        else std::cout << CYAN << "No files found in the specified directories." << RESET << std::endl;
+        return 0;
+    }
+
+    // Confirm renaming unless forced
+    if (!force) {
+        std::string confirm;
+        std::cout << "\nRename files? (y/N): ";
+        std::getline(confirm_in, confirm);
+
+        if (confirm != "y" && confirm != "Y") {
+            std::cout << CYAN << "Operation aborted." << RESET << std::endl;
+            return 0;
+        }
+    }
+    else {
+        std::cout << std::endl; // Formatting
+    }
+
+    // Directories are independent clash scopes, so they can be renamed in parallel
+    run_in_pool(scopes.size(), [&](size_t i) {
+        BatchScope& scope = scopes[i];
+        if (scope.error.empty() && !scope.clashing) scope.rename_count = rename_files(scope.files);
+    });
+
+    size_t rename_count = 0;
+    size_t directory_count = 0;
+    for (const auto& scope : scopes) {
+        rename_count += scope.rename_count;
+        if (scope.rename_count > 0) directory_count++;
+    }
+    print_rename_summary(rename_count, file_count - rename_count, directory_count);
+    if (clashing_count > 0) {
+        std::cout << CYAN << "Left " << clashing_count << " "
+                  << (clashing_count == 1 ? "directory" : "directories")
+                  << " unchanged due to clashes. Use -f or --force to ignore clashes." << RESET << std::endl;
+    }
+
+    return 0;
+}
+
+// Prints the diagnostics summary (and writes the error log, if any) when main returns
+struct DiagnosticsReport {
+    std::string error_log;
+
+    ~DiagnosticsReport() {
+        print_diagnostics_summary();
+        if (!error_log.empty()) write_diagnostics_log(error_log);
+    }
+};
+
+// Get the number of rows to show per page in interactive mode
+size_t get_page_size() {
+    struct winsize window;
+    if (ioctl(STDOUT_FILENO, TIOCGWINSZ, &window) == 0 && window.ws_row > 16) {
+        return window.ws_row - 6; // Leave room for the header and prompts
+    }
+    return 40;
+}
+
 std::string get_default_config_path() {
     // Get user's home directory
     const char* home = getenv("HOME");
@@ -80,11 +406,20 @@ std::string get_default_config_path() {
 
 // Print help menu
 void print_help() {
-    std::cout << "Usage: timestamp [directory] [--config-file <path>] [-f|--force] [-i|--interactive] [-h|--help]" << std::endl;
+    std::cout << "Usage: timestamp [directory] [--config-file <path>] [-f|--force] [-i|--interactive] [-s|--skip-conforming] [-l|--locality-order] [-p|--pair] [--from <file>|--stdin0] [--max-iops <n>] [--max-read-mbps <n>] [--max-renames-per-sec <n>] [--error-log <path>] [-h|--help]" << std::endl;
     std::cout << "Options:" << std::endl;
     std::cout << "  -c, --config-file <path>        Specify YAML configuration file" << std::endl;
     std::cout << "  -f, --force                     Force execution (will delete clashing files, not recommended)" << std::endl;
     std::cout << "  -i, --interactive               Enable interactive mode" << std::endl;
+    std::cout << "  -s, --skip-conforming           Skip files already named in the configured date format" << std::endl;
+    std::cout << "  -l, --locality-order            Read metadata in on-disk order (faster on spinning disks)" << std::endl;
+    std::cout << "  -p, --pair                      Rename files sharing a stem (RAW, JPEG, XMP sidecar) together" << std::endl;
+    std::cout << "      --from <file>               Process a NUL-delimited list of directories and files" << std::endl;
+    std::cout << "      --stdin0                    Process a NUL-delimited list of directories and files from stdin" << std::endl;
+    std::cout << "      --max-iops <n>              Limit file operations per second" << std::endl;
+    std::cout << "      --max-read-mbps <n>         Limit megabytes read per second" << std::endl;
+    std::cout << "      --max-renames-per-sec <n>   Limit renames per second" << std::endl;
+    std::cout << "      --error-log <path>          Write every warning and error as JSON lines" << std::endl;
     std::cout << "  -h, --help                      Show this help message" << std::endl;
 }
 
@@ -95,12 +430,30 @@ int main(int argc, char* argv[]) {
     bool using_default_config = true;
     bool force = false;
     bool interactive = false;
+    bool skip_conforming = false;
+    bool locality_order = false;
+    bool pair = false;
+    std::string manifest_file;
+    bool manifest_stdin = false;
+    double max_iops = 0;
+    double max_read_mbps = 0;
+    double max_renames_per_sec = 0;
+    std::string error_log;
 
     // Option structure for getopt_long
     static struct option long_options[] = {
         {"config-file", required_argument, 0,  'c' },
         {"force",       no_argument,       0,  'f' },
         {"interactive", no_argument,       0,  'i' },
+        {"skip-conforming", no_argument,   0,  's' },
+        {"locality-order", no_argument,    0,  'l' },
+        {"pair",        no_argument,       0,  'p' },
+        {"from",        required_argument, 0,  'F' },
+        {"stdin0",      no_argument,       0,  '0' },
+        {"max-iops",    required_argument, 0,  'I' },
+        {"max-read-mbps", required_argument, 0, 'M' },
+        {"max-renames-per-sec", required_argument, 0, 'R' },
+        {"error-log",   required_argument, 0,  'E' },
         {"help",        no_argument,       0,  'h' },
         {0,             0,                 0,   0  }
     };
@@ -110,7 +463,7 @@ int main(int argc, char* argv[]) {
     opterr = 0;
 
     // Loop to parse command-line arguments
-    while ((opt = getopt_long(argc, argv, "c:fih", long_options, &option_index)) != -1) {
+    while ((opt = getopt_long(argc, argv, "c:fislph", long_options, &option_index)) != -1) {
         switch (opt) {
             case 'f':
                 force = true;
@@ -122,6 +475,44 @@ int main(int argc, char* argv[]) {
             case 'i':
                 interactive = true;
                 break;
+            case 's':
+                skip_conforming = true;
+                break;
+            case 'l':
+                locality_order = true;
+                break;
+            case 'p':
+                pair = true;
+                break;
+            case 'F':
+                manifest_file = optarg;
+                break;
+            case '0':
+                manifest_stdin = true;
+                break;
+            case 'E':
+                error_log = optarg;
+                break;
+            case 'I':
+            case 'M':
+            case 'R': {
+                double limit;
+                try {
+                    limit = std::stod(optarg);
+                }
+                catch (...) {
+                    limit = -1;
+                }
+                if (limit <= 0) {
+                    std::cerr << RED << "[ERROR] " << RESET << "Invalid limit: " << optarg << ". Use a positive number" << std::endl;
+                    return 1;
+                }
+
+                if (opt == 'I') max_iops = limit;
+                else if (opt == 'M') max_read_mbps = limit;
+                else max_renames_per_sec = limit;
+                break;
+            }
             case 'h':
                 print_help();
                 return 0;
@@ -132,8 +523,9 @@ int main(int argc, char* argv[]) {
     }
 
     // Handle any positional argument as directory
+    bool batch = !manifest_file.empty() || manifest_stdin;
     for (int i = optind; i < argc; ++i) {
-        if (argv[i][0] != '-') {
+        if (argv[i][0] != '-' && !batch) {
             directory = argv[i]; // Set the first positional argument as directory
         }
         else {
@@ -142,6 +534,23 @@ int main(int argc, char* argv[]) {
         }
     }
 
+    // Per-file problems are collected and summarised on exit
+    DiagnosticsReport diagnostics_report{error_log};
+    if (!error_log.empty()) enable_diagnostics_log();
+
+    // Throttle metadata reads and renames
+    io_budget().configure(max_iops, max_read_mbps, max_renames_per_sec);
+
+    // Batch mode reads its directories from the manifest and has nobody to edit with
+    if (!manifest_file.empty() && manifest_stdin) {
+        std::cerr << RED << "[ERROR] " << RESET << "--from and --stdin0 cannot be used together" << std::endl;
+        return 1;
+    }
+    if (batch && interactive) {
+        std::cerr << RED << "[ERROR] " << RESET << "-i or --interactive cannot be used with --from or --stdin0" << std::endl;
+        return 1;
+    }
+
     // Ensure config file is good
     if (!std::ifstream(config_file)) {
         if (using_default_config) {
@@ -171,39 +580,141 @@ int main(int argc, char* argv[]) {
         force = false;
     }
 
-    std::vector<DatedFile> files;
-    auto proposed_name_counts_ptr = std::make_shared<std::map<std::string, int>>();
+    // Warn about locality order and interactive
+    if (locality_order && interactive) {
+        std::cerr << YELLOW << "[WARNING] " << RESET << "-l or --locality-order has no effect in interactive mode" << std::endl;
+        locality_order = false;
+    }
 
-    // Collect files from the specified directory
-    for (const auto& entry : fs::directory_iterator(directory)) {
-        if (fs::is_regular_file(entry)) {
-            DatedFile file = DatedFile(settings.value(), entry.path(), proposed_name_counts_ptr);
-            
-            // Ignore files without valid EXIF dates
-            if (!file.is_skipped()) {
-                files.push_back(file);
+    // Build the matcher for already conforming names once
+    std::optional<DateFormatMatcher> conforming_matcher;
+    if (skip_conforming) conforming_matcher.emplace(settings->get_date_format());
+
+    // The XMP toolkit must be initialised before it is used from several threads
+    Exiv2::XmpParser::initialize();
+
+    // Process every directory from the manifest in this process
+    if (batch) {
+        // Stdin holds the manifest, so confirmation has to come from the terminal
+        std::ifstream tty;
+        if (manifest_stdin && !force) {
+            tty.open("/dev/tty");
+            if (!tty.is_open()) {
+                std::cerr << RED << "[ERROR] " << RESET << "No terminal to confirm renames from. Use -f or --force, or --from" << std::endl;
+                return 1;
             }
-            else {
-                std::cerr << YELLOW << "[WARNING] " << RESET << "Ignoring file without valid date: " << file.get_path().filename().string() << std::endl;
+        }
+        std::istream& confirm_in = manifest_stdin ? static_cast<std::istream&>(tty) : std::cin;
+
+        std::vector<fs::path> entries;
+        if (manifest_stdin) {
+            entries = read_manifest(std::cin);
+        }
+        else {
+            std::ifstream manifest(manifest_file, std::ios::binary);
+            if (!manifest) {
+                std::cerr << RED << "[ERROR] " << RESET << "Failed to open manifest file: " << manifest_file << std::endl;
+                return 1;
             }
+            entries = read_manifest(manifest);
         }
+
+        return run_batch(settings.value(), entries, confirm_in, conforming_matcher, force, locality_order, pair);
     }
 
-    // Check if no files found
-    if (files.empty()) {
-        std::cout << CYAN << "No files found in the specified directory." << RESET << std::endl;
-        return 0;
+    std::vector<DatedFile> files;
+    auto proposed_name_counts_ptr = std::make_shared<std::map<std::string, int>>();
+    size_t conforming_count = 0;
+
+    // Collect files from the specified directory
+    std::vector<fs::path> paths = collect_paths(directory, conforming_matcher, {},
+                                                proposed_name_counts_ptr, conforming_count);
+    std::vector<std::vector<fs::path>> groups = group_paths(paths, pair);
+
+    if (conforming_count > 0) {
+        std::cout << CYAN << "Skipped " << conforming_count << " already conforming "
+                  << (conforming_count == 1 ? "file" : "files") << "." << RESET << std::endl;
     }
 
-    // Sort by filename in reverse alphabetical order (will be shown in alphabetical order)
-    std::sort(files.begin(), files.end(), [](const DatedFile& a, const DatedFile& b) {
-        return a.get_path() > b.get_path(); // Reverse order based on paths
-    });
+    // Shared with the background loader in interactive mode
+    std::mutex files_mutex;
+    size_t loaded_count = 0;
+    std::jthread loader;
+
+    if (interactive) {
+        // Add files in reverse alphabetical order so row numbers stay stable as results arrive
+        // (groups are read when their first file is reached, and may interleave with other groups)
+        std::vector<fs::path> order = paths;
+        std::sort(order.begin(), order.end(), std::greater<>());
+        std::map<fs::path, size_t> group_of;
+        for (size_t i = 0; i < groups.size(); ++i) {
+            for (const auto& path : groups[i]) group_of[path] = i;
+        }
+
+        // Read metadata in the background so the listing can be shown straight away
+        loader = std::jthread([&, order = std::move(order), group_of = std::move(group_of)](std::stop_token stop) {
+            auto scratch_counts_ptr = std::make_shared<std::map<std::string, int>>();
+            std::map<fs::path, DatedFile> pending;     // Read with an earlier file of their group
+            std::map<size_t, size_t> group_rows;       // Row of the first listed file of each group
+            for (const auto& path : order) {
+                if (stop.stop_requested()) return;
+                size_t group = group_of.at(path);
+                if (!pending.contains(path)) {
+                    for (auto& file : load_group(settings.value(), groups[group], scratch_counts_ptr)) {
+                        pending.emplace(file.get_path(), std::move(file));
+                    }
+                }
+                DatedFile file = std::move(pending.extract(path).mapped());
+
+                std::lock_guard<std::mutex> lock(files_mutex);
+                file.set_proposed_name_counts(proposed_name_counts_ptr);
+                loaded_count++;
+                if (file.is_skipped()) {
+                    report(DiagCode::NoValidDate, file.get_path());
+                    continue;
+                }
+
+                // Keep any skip or edit already made to the rest of the group
+                auto row = group_rows.find(group);
+                if (row != group_rows.end()) file.follow(files[row->second]);
+                else group_rows[group] = files.size();
+                files.push_back(file);
+            }
+        });
+    }
+    else {
+        files = load_files(settings.value(), std::move(groups), proposed_name_counts_ptr, locality_order);
+        loaded_count = paths.size();
+    }
 
     bool first_loop = true;
     bool show_clash_error = false;
+    size_t page = 0;
+    size_t page_size = interactive ? get_page_size() : 0;
     while(true) {
-        display_proposed_changes(files, first_loop);
+        bool loading;
+        {
+            std::lock_guard<std::mutex> lock(files_mutex);
+            loading = loaded_count < paths.size();
+
+            // Check if no files found
+            if (!loading && files.empty()) {
+                std::cout << CYAN << "No files found in the specified directory." << RESET << std::endl;
+                return 0;
+            }
+
+            // Keep the page in range and show it
+            if (page_size && page * page_size >= files.size()) page = files.empty() ? 0 : (files.size() - 1) / page_size;
+            display_proposed_changes(files, first_loop, page, page_size);
+
+            if (interactive) {
+                size_t first = page * page_size;
+                std::cout << GRAY << "Showing " << (files.empty() ? 0 : first + 1) << "-" << std::min(files.size(), first + page_size)
+                          << " of " << files.size();
+                if (loading) std::cout << " (read " << loaded_count << " of " << paths.size() << " files, press enter to refresh)";
+                std::cout << RESET << std::endl;
+            }
+        }
         first_loop = false;
 
         // Only show clash error (or add newline) in interactive mode
@@ -218,12 +729,17 @@ int main(int argc, char* argv[]) {
         // Only ask to edit operations in interactive mode
         std::string input;
         if (interactive) {
-            std::cout << "Operations to edit (e.g., '1 2 3', '1-3', '^4'): ";
+            std::cout << "Operations to edit (e.g., '1 2 3', '1-3', '^4', 'n'/'p' to change page): ";
             std::getline(std::cin, input);
         }
 
         // Exit the loop if no options are selected (or if not in interactive mode)
         if (input.empty()) {
+            // Refresh the listing until every file has been read
+            if (loading) continue;
+
+            std::lock_guard<std::mutex> lock(files_mutex);
+
             // If there are clashes
             if (has_clashes(proposed_name_counts_ptr)) {
                 // In interactive mode, give the user the opportunity to fix clashes
@@ -244,6 +760,20 @@ int main(int argc, char* argv[]) {
             break;
         }
 
+        // Page through the listing
+        if (input == "n" || input == "p") {
+            if (input == "p" && page > 0) page--;
+            else if (input == "n") page++; // Clamped to the last page when displayed
+            continue;
+        }
+
+        // Only rows already loaded can be selected
+        size_t loaded_rows;
+        {
+            std::lock_guard<std::mutex> lock(files_mutex);
+            loaded_rows = files.size();
+        }
+
         // Use a set to store unique selections
         std::set<size_t> selected_files;
         std::istringstream stream(input);
@@ -253,7 +783,7 @@ int main(int argc, char* argv[]) {
             // Handle range selection
             if (token.front() == '^') {
                 size_t start = std::stoi(token.substr(1));
-                for (size_t i = start; i < files.size(); ++i) {
+                for (size_t i = start; i < loaded_rows; ++i) {
                     selected_files.insert(i + 1);
                 }
             }
@@ -277,19 +807,36 @@ int main(int argc, char* argv[]) {
         std::cout << "Skip or edit selected operations? (S/e): ";
         std::getline(std::cin, skip_or_edit);
 
-        // Apply the edits for selected files
+        // Apply the edits for selected files (and the rest of their group)
         if (skip_or_edit == "e" || skip_or_edit == "E") {
+            std::set<size_t> edited;
             for (const auto& index : selected_files) {
-                if (index > 0 && index <= files.size()) {
-                    files[index - 1].edit_proposed_name();
+                if (index > 0 && index <= loaded_rows && !edited.contains(index - 1)) {
+                    // Prompt on a copy so the loader keeps going while the user decides
+                    std::optional<DatedFile> file;
+                    {
+                        std::lock_guard<std::mutex> lock(files_mutex);
+                        file = files[index - 1];
+                    }
+
+                    auto choice = file->prompt_proposed_name();
+                    if (choice) {
+                        std::lock_guard<std::mutex> lock(files_mutex);
+                        files[index - 1].apply_proposed_name(*choice);
+                        for (size_t i : get_group_indices(files, index - 1, pair)) {
+                            if (i != index - 1) files[i].follow(files[index - 1]);
+                            edited.insert(i);
+                        }
+                    }
                 }
             }
         }
         // Skip selected files
         else {
+            std::lock_guard<std::mutex> lock(files_mutex);
             for (const auto& index : selected_files) {
-                if (index > 0 && index <= files.size()) {
-                    files[index - 1].set_skipped();
+                if (index > 0 && index <= loaded_rows) {
+                    for (size_t i : get_group_indices(files, index - 1, pair)) files[i].set_skipped();
                 }
             }
         }
@@ -300,7 +847,8 @@ int main(int argc, char* argv[]) {
     // If force, just do it
     if (force) {
         std::cout << std::endl; // Formatting
-        rename_files(files);
+        size_t rename_count = rename_files(files);
+        print_rename_summary(rename_count, files.size() - rename_count);
     }
     // Else confirm renaming
     else {
@@ -309,7 +857,8 @@ int main(int argc, char* argv[]) {
         std::getline(std::cin, confirm);
 
         if (confirm == "y" || confirm == "Y") {
-            rename_files(files);
+            size_t rename_count = rename_files(files);
+            print_rename_summary(rename_count, files.size() - rename_count);
         }
         else {
             std::cout << CYAN << "Operation aborted." << RESET << std::endl;
@@ -1,12 +1,22 @@
 #include "utility.h"
 
+#include <algorithm>
+#include <cctype>
+#include <fcntl.h>
 #include <format>
+#include <linux/fiemap.h>
+#include <linux/fs.h>
+#include <sstream>
+#include <string_view>
+#include <sys/ioctl.h>
+#include <sys/stat.h>
+#include <unistd.h>
 
-std::chrono::system_clock::time_point exif_date_to_time_point(const std::string& exif_date) {
+std::optional<std::chrono::system_clock::time_point> exif_date_to_time_point(const std::string& exif_date) {
     std::chrono::system_clock::time_point time;
     std::istringstream ss(exif_date);
     ss >> std::chrono::parse("%Y:%m:%d %H:%M:%S", time);
-    if (ss.fail()) throw std::runtime_error("Failed to parse EXIF date using chrono::parse");
+    if (ss.fail()) return std::nullopt;
     return time;
 }
 
@@ -14,6 +24,22 @@ std::chrono::system_clock::time_point xmp_epoch_to_time_point(long long xmp_epoc
     return std::chrono::time_point<std::chrono::system_clock>(std::chrono::seconds(xmp_epoch - SECONDS_DIFFERENCE_1904_1970));
 }
 
+std::optional<std::chrono::system_clock::time_point> xmp_date_to_time_point(const std::string& xmp_date) {
+    // Only the date and time are used, any fractional seconds or offset are ignored like EXIF dates
+    std::string date = xmp_date;
+    if (date.size() > 10) date = date.substr(0, date.find_first_of("+-Z.", 11));
+
+    // XMP allows reduced precision (e.g. "2019" or "2019-06"), so fill in the earliest values for missing fields
+    static const std::string EARLIEST = "0000-01-01T00:00:00";
+    if (date.size() == 4 || date.size() == 7 || date.size() == 10 || date.size() == 16) date += EARLIEST.substr(date.size());
+
+    std::chrono::system_clock::time_point time;
+    std::istringstream ss(date);
+    ss >> std::chrono::parse("%Y-%m-%dT%H:%M:%S", time);
+    if (ss.fail()) return std::nullopt;
+    return time;
+}
+
 std::chrono::system_clock::time_point epoch_to_time_point(time_t epoch) {
     return std::chrono::system_clock::from_time_t(epoch);
 }
@@ -28,3 +54,88 @@ std::string time_point_to_formatted_string(const std::chrono::system_clock::time
     }
     return std::format(std::runtime_format(final_date_format), rounded_time);
 }
+
+DateFormatMatcher::DateFormatMatcher(const std::string& date_format) : date_format{date_format} {
+    // Translate each conversion into the exact text it formats to, so only canonical names match
+    std::string pattern = "(";
+    for (size_t i = 0; i < date_format.size(); ++i) {
+        char c = date_format[i];
+        if (c != '%' || i + 1 == date_format.size()) {
+            if (std::string_view("\\^$.|?*+()[]{}").find(c) != std::string_view::npos) pattern += '\\';
+            pattern += c;
+            continue;
+        }
+
+        switch (date_format[++i]) {
+            case 'Y': case 'G':                     pattern += "\\d{4}"; break;
+            case 'm': case 'd': case 'H': case 'M':
+            case 'S': case 'y': case 'I': case 'C':
+            case 'U': case 'W': case 'V': case 'g': pattern += "\\d{2}"; break;
+            case 'j':                               pattern += "\\d{3}"; break;
+            case 'e':                               pattern += "[ \\d]\\d"; break;
+            case 'u': case 'w':                     pattern += "\\d"; break;
+            case 'F':                               pattern += "\\d{4}-\\d{2}-\\d{2}"; break;
+            case 'T':                               pattern += "\\d{2}:\\d{2}:\\d{2}"; break;
+            case 'R':                               pattern += "\\d{2}:\\d{2}"; break;
+            case 'a': case 'A': case 'b': case 'B':
+            case 'h': case 'p':                     pattern += "[A-Za-z]+"; break;
+            case '%':                               pattern += "%"; break;
+            default:                                pattern += ".+?"; break;
+        }
+    }
+
+    // Allow a trailing clash suffix such as "_1", "-2" or " (3)"
+    pattern += ")(?:[-_ ]\\d+|[-_ ]?\\(\\d+\\))?";
+    this->pattern = std::regex(pattern, std::regex::optimize);
+}
+
+bool DateFormatMatcher::matches(const std::string& stem) const {
+    std::smatch match;
+    if (!std::regex_match(stem, match, this->pattern)) return false;
+
+    // The date must also be valid and format back to exactly the same text
+    std::string date = match[1].str();
+    std::chrono::sys_seconds time;
+    std::istringstream ss(date);
+    ss >> std::chrono::parse(this->date_format, time);
+    if (ss.fail() || ss.peek() != std::char_traits<char>::eof()) return false;
+
+    return time_point_to_formatted_string(time, this->date_format) == date;
+}
+
+PhysicalLocation get_physical_location(const std::filesystem::path& path) {
+    // Prefer the physical offset of the first extent, if the filesystem reports one
+    int fd = open(path.c_str(), O_RDONLY | O_CLOEXEC);
+    if (fd >= 0) {
+        alignas(struct fiemap) unsigned char buffer[sizeof(struct fiemap) + sizeof(struct fiemap_extent)] = {};
+        auto* map = reinterpret_cast<struct fiemap*>(buffer);
+        map->fm_length = FIEMAP_MAX_OFFSET;
+        map->fm_extent_count = 1;
+
+        bool mapped = ioctl(fd, FS_IOC_FIEMAP, map) == 0 && map->fm_mapped_extents > 0;
+        close(fd);
+        if (mapped && !(map->fm_extents[0].fe_flags & FIEMAP_EXTENT_UNKNOWN)) return {false, map->fm_extents[0].fe_physical};
+    }
+
+    // Otherwise fall back to the inode number, which roughly tracks allocation order
+    struct stat file_stat;
+    if (stat(path.c_str(), &file_stat) != 0) return {true, UINT64_MAX};
+    return {true, file_stat.st_ino};
+}
+
+bool is_sidecar(const std::filesystem::path& path) {
+    std::string extension = path.extension().string();
+    std::transform(extension.begin(), extension.end(), extension.begin(), [](unsigned char c) { return std::tolower(c); });
+    return extension == ".xmp";
+}
+
+std::string get_group_stem(const std::filesystem::path& path) {
+    // Sidecars named like IMG_1234.CR2.xmp belong with IMG_1234.CR2
+    std::filesystem::path stem = path.stem();
+    if (is_sidecar(path) && stem.has_extension()) stem = stem.stem();
+    return stem.string();
+}
+
+std::string get_group_suffix(const std::filesystem::path& path) {
+    return path.filename().string().substr(get_group_stem(path).size());
+}
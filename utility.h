@@ -2,12 +2,41 @@
 #define UTILITY_H
 
 #include <chrono>
+#include <compare>
+#include <cstdint>
+#include <filesystem>
+#include <optional>
+#include <regex>
+#include <string>
 
 #define SECONDS_DIFFERENCE_1904_1970 2082844800
 
-std::chrono::system_clock::time_point exif_date_to_time_point(const std::string& exif_date);
+std::optional<std::chrono::system_clock::time_point> exif_date_to_time_point(const std::string& exif_date);
 std::chrono::system_clock::time_point xmp_epoch_to_time_point(long long xmp_epoch);
+std::optional<std::chrono::system_clock::time_point> xmp_date_to_time_point(const std::string& xmp_date);
 std::chrono::system_clock::time_point epoch_to_time_point(time_t epoch);
 std::string time_point_to_formatted_string(const std::chrono::system_clock::time_point& time, const std::string& date_format, bool localtime = false);
+// Recognises stems already named in a date format, optionally followed by a clash suffix
+class DateFormatMatcher {
+private:
+    std::string date_format;
+    std::regex pattern;
+
+public:
+    DateFormatMatcher(const std::string& date_format);
+    bool matches(const std::string& stem) const;
+};
+
+// Where a file lies on disk: FIEMAP offsets and inode numbers are not comparable, so inode-keyed files sort last
+struct PhysicalLocation {
+    bool by_inode;
+    uint64_t key;
+    auto operator<=>(const PhysicalLocation&) const = default;
+};
+
+PhysicalLocation get_physical_location(const std::filesystem::path& path);
+bool is_sidecar(const std::filesystem::path& path);
+std::string get_group_stem(const std::filesystem::path& path);
+std::string get_group_suffix(const std::filesystem::path& path);
 
 #endif // UTILITY_H
\ No newline at end of file